@@ -8,6 +8,8 @@
 
 #include "volumeControlService.h"
 
+#include <string.h>
+
 LOG_MODULE_REGISTER(vcs, 4);
 
 /** @brief Volume flags state for Volume Flags characteristic (0x2B7F) */
@@ -26,22 +28,170 @@ struct volumeState vcsState = {
 	.changeCounter = 0,   // Initial synchronization counter
 };
 
-void notifyVolumeState(struct bt_conn *conn) {
-    if (notifyStateEnabled) {
-        bt_gatt_notify(conn, &vcsSvc.attrs[2], &vcsState, sizeof(vcsState));
-    }
+/**
+ * @brief ATT traffic of the current burst, guarded by burstLock
+ * @details A burst runs from its first operation to its last one before
+ *          TRAFFIC_BURST_GAP_MS of idle time, so connection setup and idle
+ *          periods do not dilute the measured throughput.
+ */
+static struct {
+	int64_t start;                         /**< Uptime (ms) of the first operation */
+	int64_t last;                          /**< Uptime (ms) of the latest operation */
+	uint32_t count[TRAFFIC_TYPE_COUNT];    /**< Operations per traffic kind */
+	size_t bearers;                        /**< Most ATT bearers seen on the link */
+} burst;
+
+static struct k_spinlock burstLock;
+
+static void burstHandler(struct k_work *work);
+
+/** @brief Reports the burst once the link has been idle for TRAFFIC_BURST_GAP_MS */
+static K_WORK_DELAYABLE_DEFINE(burstWork, burstHandler);
+
+/* Counts one ATT operation towards the current burst */
+static void trafficRecord(struct bt_conn *conn, enum TRAFFIC_TYPES type)
+{
+	int64_t now = k_uptime_get();
+	size_t bearers = 0;
+
+#if defined(CONFIG_BT_EATT)
+	if (conn) {
+		bearers = 1 + bt_eatt_count(conn); // Unenhanced bearer plus connected EATT channels
+	}
+#else
+	bearers = conn ? 1 : 0;
+#endif
+
+	k_spinlock_key_t key = k_spin_lock(&burstLock);
+	if (burst.start == 0) {
+		burst.start = now;
+	}
+	burst.last = now;
+	burst.count[type]++;
+	burst.bearers = MAX(burst.bearers, bearers);
+	k_spin_unlock(&burstLock, key);
+
+	k_work_reschedule(&burstWork, K_MSEC(TRAFFIC_BURST_GAP_MS));
+}
+
+static void burstHandler(struct k_work *work)
+{
+	(void)(work);
+
+	k_spinlock_key_t key = k_spin_lock(&burstLock);
+	uint32_t reads = burst.count[TRAFFIC_READ];
+	uint32_t writes = burst.count[TRAFFIC_WRITE];
+	uint32_t notifications = burst.count[TRAFFIC_NOTIFY];
+	uint32_t duration = (uint32_t)(burst.last - burst.start);
+	size_t bearers = burst.bearers;
+	memset(&burst, 0, sizeof(burst));
+	k_spin_unlock(&burstLock, key);
+
+	uint32_t ops = reads + writes + notifications;
+	if (ops < TRAFFIC_BURST_MIN_OPS) {
+		return;
+	}
+
+	duration = MAX(duration, 1);
+	LOG_INF("Burst: %u reads, %u writes, %u notifications in %u ms (%u ops/s) over %u bearer(s)\n",
+		reads, writes, notifications, duration, (uint32_t)((uint64_t)ops * 1000 / duration),
+		(uint32_t)bearers);
+}
+
+/** @brief Called after each accepted Control Point write, see vcsCommandCallbackSet() */
+static vcsCommandCb commandCb;
+
+/**
+ * @brief Serializes Volume State updates between the Bluetooth RX thread and local input
+ * @note With EATT a client may have Control Point writes in flight on several bearers;
+ *       the change counter check and update happen under this lock so only one of two
+ *       writes carrying the same counter can succeed.
+ */
+K_MUTEX_DEFINE(vcsLock);
+
+/** @brief Uptime (ms) of the last Volume State notification, guarded by vcsLock */
+static int64_t lastStateNotify;
+
+static void notifyStateHandler(struct k_work *work);
+static void notifyVolumeFlags(struct bt_conn *conn);
+
+/** @brief Delayed Volume State notification used to coalesce local changes */
+static K_WORK_DELAYABLE_DEFINE(notifyStateWork, notifyStateHandler);
+
+int notifyVolumeState(struct bt_conn *conn) {
+	struct volumeState snapshot;
+	bool stale;
+	int err;
+
+	if (!notifyStateEnabled) {
+		return 0;
+	}
+
+	k_mutex_lock(&vcsLock, K_FOREVER);
+	snapshot = vcsState;
+	lastStateNotify = k_uptime_get();
+	k_mutex_unlock(&vcsLock);
+
+	err = bt_gatt_notify(conn, &vcsSvc.attrs[2], &snapshot, sizeof(snapshot));
+	if (err == 0) {
+		trafficRecord(conn, TRAFFIC_NOTIFY);
+	}
+
+	// The state may have moved on while this notification waited for a buffer, and a newer one
+	// may already be out; follow up so the last notification a client sees is the current state
+	k_mutex_lock(&vcsLock, K_FOREVER);
+	stale = snapshot.changeCounter != vcsState.changeCounter;
+	k_mutex_unlock(&vcsLock);
+
+	if (err && err != -ENOTCONN) {
+		// Out of ATT buffers; dropping it would leave clients with an old Change Counter
+		LOG_WRN("Volume State notification failed (%d), retrying\n", err);
+		k_work_reschedule(&notifyStateWork, K_MSEC(VOLUME_NOTIFY_COALESCE_MS));
+	} else if (stale) {
+		k_work_reschedule(&notifyStateWork, K_NO_WAIT);
+	}
+
+	return err;
+}
+
+/* Sends the latest Volume State to all subscribed clients once the coalescing window has passed */
+static void notifyStateHandler(struct k_work *work)
+{
+	(void)(work);
+
+	notifyVolumeState(NULL);
+}
+
+void vcsCommandCallbackSet(vcsCommandCb cb) {
+	commandCb = cb;
 }
 
 /* GATT read handler for Volume State (0x2B7D) */
 ssize_t readVolumeState(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf, uint16_t len, uint16_t offset)
 {
-	return bt_gatt_attr_read(conn, attr, buf, len, offset, &vcsState, sizeof(vcsState));
+	struct volumeState snapshot;
+
+	trafficRecord(conn, TRAFFIC_READ);
+
+	k_mutex_lock(&vcsLock, K_FOREVER);
+	snapshot = vcsState;
+	k_mutex_unlock(&vcsLock);
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &snapshot, sizeof(snapshot));
 }
 
 /* GATT read handler for Volume State Flags (0x2B7F) */
 ssize_t readVolumeFlags(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf, uint16_t len, uint16_t offset)
 {
-	return bt_gatt_attr_read(conn, attr, buf, len, offset, &volumeFlags, sizeof(volumeFlags));
+	uint8_t snapshot;
+
+	trafficRecord(conn, TRAFFIC_READ);
+
+	k_mutex_lock(&vcsLock, K_FOREVER);
+	snapshot = volumeFlags;
+	k_mutex_unlock(&vcsLock);
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &snapshot, sizeof(snapshot));
 }
 
 /* Volume State Characteristic Client Configuration Descriptor (CCCD) changed handler */
@@ -59,13 +209,38 @@ void volumeFlagsCccdChanged(const struct bt_gatt_attr *attr, uint16_t value)
 }
 
 /**
+ * @note Volume Flags are only notified when the value actually changes, as the VCS spec
+ *       requires; repeated volume writes no longer re-notify an unchanged flag.
  * @note The flags should ideally be stored in non-volatile memory along with the volume state
  *       but that is however not implemented in this demonstration.
  */
 void volumeFlagsSet(uint8_t flags, struct bt_conn *conn) {
+	bool changed;
+
+	k_mutex_lock(&vcsLock, K_FOREVER);
+	changed = volumeFlags != flags;
 	volumeFlags = flags;
-	if (notifyFlagsEnabled) {
-		bt_gatt_notify(conn, &vcsSvc.attrs[7], &volumeFlags, sizeof(volumeFlags));
+	k_mutex_unlock(&vcsLock);
+
+	if (changed) {
+		notifyVolumeFlags(conn); // Only notify on an actual change
+	}
+}
+
+/* Sends the current Volume Flags to subscribed clients */
+static void notifyVolumeFlags(struct bt_conn *conn) {
+	uint8_t snapshot;
+
+	if (!notifyFlagsEnabled) {
+		return;
+	}
+
+	k_mutex_lock(&vcsLock, K_FOREVER);
+	snapshot = volumeFlags;
+	k_mutex_unlock(&vcsLock);
+
+	if (bt_gatt_notify(conn, &vcsSvc.attrs[7], &snapshot, sizeof(snapshot)) == 0) {
+		trafficRecord(conn, TRAFFIC_NOTIFY);
 	}
 }
 
@@ -77,7 +252,7 @@ void volumeFlagsSet(uint8_t flags, struct bt_conn *conn) {
  *          Fulfills VCP equation: Volume_Setting = max(VolumeSetting - Step Size, 0)
  */
 void volumeDown(uint8_t *volume) {
-	*volume = *volume == VOLUME_MIN ? VOLUME_MIN : *volume - VOLUME_STEP_SIZE;
+	*volume = *volume < VOLUME_MIN + VOLUME_STEP_SIZE ? VOLUME_MIN : *volume - VOLUME_STEP_SIZE;
 	LOG_DBG("Volume down: %d\n", *volume);
 }
 
@@ -87,7 +262,7 @@ void volumeDown(uint8_t *volume) {
  *          Fulfills VCP equation: Volume_Setting = min(VolumeSetting + Step Size, 255)
  */
 void volumeUp(uint8_t *volume) {
-	*volume = *volume == VOLUME_MAX ? VOLUME_MAX : *volume + VOLUME_STEP_SIZE;
+	*volume = *volume > VOLUME_MAX - VOLUME_STEP_SIZE ? VOLUME_MAX : *volume + VOLUME_STEP_SIZE;
 	LOG_DBG("Volume up: %d\n", *volume);
 }
 
@@ -111,25 +286,28 @@ void volumeMute(void) {
 	LOG_DBG("Volume muted\n");
 }
 
-void changeCounterIncrement(struct bt_conn *conn) {
-	vcsState.changeCounter++;
-	notifyVolumeState(conn);
-}
-
-/* GATT write handler for Volume Control Point (0x2B7E) */
-ssize_t writeVolumeControlPoint(struct bt_conn *conn, const struct bt_gatt_attr *attr, const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+/**
+ * @brief Applies one Volume Control Point operation to vcsState
+ * @details Shared state engine for remote writes and local input. Must be called with
+ *          vcsLock held. Notifications are left to the caller so they are sent unlocked.
+ * @param pdu Control Point operation: opcode, change counter and optional volume
+ * @param len Length of pdu
+ * @param skipUnchanged If true, operations that leave the state untouched are dropped
+ *                      without bumping the change counter
+ * @param flagsChanged Set to true if the operation changed volumeFlags
+ * @return 0 on success, -EALREADY if skipped, otherwise an ATT error code
+ */
+static int volumeOperationApply(const uint8_t *pdu, uint16_t len, bool skipUnchanged, bool *flagsChanged)
 {
-	if (offset != 0 || (len != 2 && len != 3)) {
-		LOG_WRN("Invalid attribute length: %d\n", len);
-		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
-	}
+	uint8_t opcode = pdu[0];
+	uint8_t operand = pdu[1];
+	struct volumeState before = vcsState;
 
-	uint8_t opcode = ((uint8_t *)buf)[0];
-	uint8_t operand = ((uint8_t *)buf)[1];
+	*flagsChanged = false;
 
 	if (operand != vcsState.changeCounter) {
 		LOG_WRN("Invalid Change Counter: %d (expected %d)\n", operand, vcsState.changeCounter);
-		return BT_GATT_ERR(ERR_INVALID_CHANGE_COUNTER);
+		return ERR_INVALID_CHANGE_COUNTER;
 	}
 
 	switch (opcode) {
@@ -155,9 +333,9 @@ ssize_t writeVolumeControlPoint(struct bt_conn *conn, const struct bt_gatt_attr
 			LOG_DBG("Opcode: VOLUME_SET_ABSOLUTE\n");
 			if (len != 3) {
 				LOG_WRN("Invalid attribute length for VOLUME_SET_ABSOLUTE: %d\n", len);
-				return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+				return BT_ATT_ERR_INVALID_ATTRIBUTE_LEN;
 			}
-			operand = ((uint8_t *)buf)[2]; // Casting it to uint8_t makes sure it's in 0-255 range
+			operand = pdu[2]; // Casting it to uint8_t makes sure it's in 0-255 range
 			volume_set(&vcsState.volumeSetting, operand);
 			break;
 		case VOLUME_UNMUTE:
@@ -171,7 +349,11 @@ ssize_t writeVolumeControlPoint(struct bt_conn *conn, const struct bt_gatt_attr
 
 		default:
 			LOG_WRN("Invalid Opcode: %d\n", opcode);
-			return BT_GATT_ERR(ERR_INVALID_OPCODE);
+			return ERR_INVALID_OPCODE;
+	}
+
+	if (skipUnchanged && before.volumeSetting == vcsState.volumeSetting && before.mute == vcsState.mute) {
+		return -EALREADY;
 	}
 
 	switch (opcode) {
@@ -180,14 +362,86 @@ ssize_t writeVolumeControlPoint(struct bt_conn *conn, const struct bt_gatt_attr
 		case VOLUME_DOWN_UNMUTE:
 		case VOLUME_UP_UNMUTE:
 		case VOLUME_SET_ABSOLUTE:
-			volumeFlagsSet((0x01 << 0), conn); // Volume changed - set Volume_Setting_Persisted flag
+			// Volume changed - set Volume_Setting_Persisted flag
+			*flagsChanged = !(volumeFlags & VOLUME_FLAG_SETTING_PERSISTED);
+			volumeFlags |= VOLUME_FLAG_SETTING_PERSISTED;
 			break;
 
 		default:
 			break;
 	}
 
-	changeCounterIncrement(conn);
+	vcsState.changeCounter++;
+
+	return 0;
+}
+
+/* GATT write handler for Volume Control Point (0x2B7E) */
+ssize_t writeVolumeControlPoint(struct bt_conn *conn, const struct bt_gatt_attr *attr, const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+	bool flagsChanged;
+	int err;
+
+	trafficRecord(conn, TRAFFIC_WRITE);
+
+	if (offset != 0 || (len != 2 && len != 3)) {
+		LOG_WRN("Invalid attribute length: %d\n", len);
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	k_mutex_lock(&vcsLock, K_FOREVER);
+	err = volumeOperationApply(buf, len, false, &flagsChanged);
+	k_mutex_unlock(&vcsLock);
+
+	if (err) {
+		return BT_GATT_ERR(err);
+	}
+
+	if (commandCb) {
+		commandCb(conn);
+	}
+
+	if (flagsChanged) {
+		notifyVolumeFlags(conn);
+	}
+
+	notifyVolumeState(conn);
 
 	return len; // Success - return number of bytes processed
-}
\ No newline at end of file
+}
+
+int volumeLocalOperation(uint8_t opcode)
+{
+	int64_t elapsed;
+	bool flagsChanged;
+	int err;
+
+	k_mutex_lock(&vcsLock, K_FOREVER);
+
+	// Resolve the toggle under the lock so a concurrent remote mute cannot turn it into a no-op
+	if (opcode == VOLUME_MUTE_TOGGLE) {
+		opcode = vcsState.mute ? VOLUME_UNMUTE : VOLUME_MUTE;
+	}
+
+	// Local input always targets the current state, so it carries the current change counter
+	uint8_t pdu[2] = { opcode, vcsState.changeCounter };
+
+	err = volumeOperationApply(pdu, sizeof(pdu), true, &flagsChanged);
+	elapsed = k_uptime_get() - lastStateNotify;
+
+	k_mutex_unlock(&vcsLock);
+
+	if (err) {
+		return err == -EALREADY ? 0 : -EINVAL;
+	}
+
+	if (flagsChanged) {
+		notifyVolumeFlags(NULL);
+	}
+
+	// Leading edge goes out immediately, further changes within the window share one notification
+	k_work_schedule(&notifyStateWork, elapsed >= VOLUME_NOTIFY_COALESCE_MS ?
+			K_NO_WAIT : K_MSEC(VOLUME_NOTIFY_COALESCE_MS - elapsed));
+
+	return 0;
+}
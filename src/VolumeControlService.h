@@ -12,6 +12,7 @@
 
 #include <zephyr/kernel.h>
 #include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/att.h>
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/logging/log.h>
 
@@ -24,9 +25,28 @@
 /** @brief Minimum volume level */
 #define VOLUME_MIN 0
 
+/** @brief Minimum spacing (ms) between Volume State notifications caused by local input */
+#define VOLUME_NOTIFY_COALESCE_MS 200
+
+/** @brief Idle time (ms) after which a burst of ATT traffic is considered finished */
+#define TRAFFIC_BURST_GAP_MS 100
+
+/** @brief Bursts with fewer operations than this are not reported */
+#define TRAFFIC_BURST_MIN_OPS 10
+
 /** @brief Volume Control Service GATT service definition */
 extern const struct bt_gatt_service_static vcsSvc;
 
+/**
+ * @brief ATT traffic kinds counted by the burst throughput measurement
+ */
+enum TRAFFIC_TYPES {
+  TRAFFIC_READ,        /**< Volume State or Volume Flags read */
+  TRAFFIC_WRITE,       /**< Volume Control Point write */
+  TRAFFIC_NOTIFY,      /**< Volume State or Volume Flags notification sent */
+  TRAFFIC_TYPE_COUNT,  /**< Number of traffic kinds */
+};
+
 /**
  * @brief VCP-specific error codes for Volume Control Point operations
  *
@@ -54,6 +74,9 @@ enum OPCODES {
   VOLUME_MUTE           /**< Mute without changing volume */
 };
 
+/** @brief Local-only pseudo opcode for volumeLocalOperation(); rejected on the Control Point */
+#define VOLUME_MUTE_TOGGLE 0xFF
+
 /**
  * @brief Volume state structure matching VCP Volume State characteristic (0x2B7D)
  *
@@ -66,17 +89,39 @@ struct volumeState {
 	uint8_t changeCounter; /**< Synchronization counter for client coordination */
 };
 
-/** @brief Volume flags characteristic value (0x2B7F) */
+/** @brief Volume_Setting_Persisted bit of the Volume Flags characteristic */
+#define VOLUME_FLAG_SETTING_PERSISTED (0x01 << 0)
+
+/** @brief Volume flags characteristic value (0x2B7F), guarded by vcsLock */
 extern uint8_t volumeFlags;
 
 /** @brief Current volume state exposed via Volume State characteristic */
 extern struct volumeState vcsState;
 
+/** @brief Mutex guarding vcsState; take it before reading the state outside this module */
+extern struct k_mutex vcsLock;
+
+/**
+ * @brief Accepted Control Point write callback
+ * @param conn Bluetooth connection the write arrived on
+ */
+typedef void (*vcsCommandCb)(struct bt_conn *conn);
+
+/**
+ * @brief Register a callback for accepted Control Point writes
+ * @details Lets the connection manager time the first volume command of a connection.
+ * @param cb Callback, or NULL to remove it
+ */
+void vcsCommandCallbackSet(vcsCommandCb cb);
+
 /**
  * @brief Send volume state notification to connected client
- * @param conn Bluetooth connection handle
+ * @details A failed notification is retried from the coalescing work item, and one
+ *          that went out with an outdated state is followed by a fresh one.
+ * @param conn Bluetooth connection handle, or NULL for all subscribed clients
+ * @return 0 on success or if notifications are disabled, negative error code otherwise
  */
-void notifyVolumeState(struct bt_conn *conn);
+int notifyVolumeState(struct bt_conn *conn);
 
 /**
  * @brief GATT read handler for Volume State characteristic (0x2B7D)
@@ -135,6 +180,17 @@ void volumeFlagsSet(uint8_t flags, struct bt_conn *conn);
  */
 ssize_t writeVolumeControlPoint(struct bt_conn *conn, const struct bt_gatt_attr *attr, const void *buf, uint16_t len, uint16_t offset, uint8_t flags);
 
+/**
+ * @brief Apply a Volume Control Point opcode originating from local input
+ * @details Runs through the same state engine as writeVolumeControlPoint() using the
+ *          current change counter. Operations that do not alter the state are dropped,
+ *          and the resulting notifications are coalesced to one per VOLUME_NOTIFY_COALESCE_MS.
+ *          Must not be called from ISR context.
+ * @param opcode Volume Control Point opcode (no operand opcodes only) or VOLUME_MUTE_TOGGLE
+ * @return 0 on success or no-op, -EINVAL on invalid opcode
+ */
+int volumeLocalOperation(uint8_t opcode);
+
 /**
  * @brief Decrease volume by step size with bounds checking
  * @param volume Pointer to current volume level to modify
@@ -157,10 +213,4 @@ void volumeMute(void);
  */
 void volumeUnmute(void);
 
-/**
- * @brief Increment change counter and notify volume state change
- * @param conn Bluetooth connection handle for notifications
- */
-void changeCounterIncrement(struct bt_conn *conn);
-
 #endif
\ No newline at end of file
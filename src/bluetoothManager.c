@@ -5,6 +5,12 @@ LOG_MODULE_REGISTER(bt_mgr, 4);
 
 struct k_work adv_start_work;
 
+/** @brief Uptime (ms) at connection, or 0 once the first volume command has been timed */
+static int64_t sessionStart;
+
+/** @brief Uptime (ms) the link got encrypted, or 0 if it has not (yet) this session */
+static int64_t encryptedAt;
+
 struct bt_data ad[] = {
   BT_DATA_BYTES(BT_DATA_NAME_SHORTENED, BT_DEVICE_NAME_SHORT),
 	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
@@ -41,6 +47,17 @@ void connected(struct bt_conn *conn, uint8_t err)
 		LOG_DBG("Connected to %s\n", addr);
 		k_work_cancel_delayable(&statusLedWork);
 		gpio_pin_set_dt(&statusLed, 1); // Turn on LED
+
+		sessionStart = k_uptime_get();
+		encryptedAt = 0;
+
+#if defined(CONFIG_BT_SMP)
+		// Pair in every build so EATT and ATT-only runs see the same setup; EATT also needs the encrypted link
+		int ret = bt_conn_set_security(conn, BT_SECURITY_L2);
+		if (ret) {
+			LOG_WRN("Failed to request security (%d)\n", ret);
+		}
+#endif
 	}
 }
 
@@ -51,11 +68,49 @@ void disconnected(struct bt_conn *conn, uint8_t reason)
 	k_work_schedule(&statusLedWork, K_MSEC(1000));
 }
 
+#if defined(CONFIG_BT_SMP)
+void securityChanged(struct bt_conn *conn, bt_security_t level, enum bt_security_err err)
+{
+	if (err) {
+		LOG_WRN("Security failed: level %u err %d\n", level, err);
+		return;
+	}
+
+	LOG_DBG("Security changed: level %u\n", level);
+
+	// Separates pairing (new peer) or re-encryption (bonded peer) from the discovery/CCCD round trips
+	if (sessionStart && !encryptedAt && level >= BT_SECURITY_L2) {
+		encryptedAt = k_uptime_get();
+		LOG_INF("Link encrypted %u ms after connect\n", (uint32_t)(encryptedAt - sessionStart));
+	}
+}
+#endif
+
 BT_CONN_CB_DEFINE(conn_callbacks) = {
 	.connected = connected,
 	.disconnected = disconnected,
+#if defined(CONFIG_BT_SMP)
+	.security_changed = securityChanged,
+#endif
 };
 
+void commandAccepted(struct bt_conn *conn)
+{
+	if (!sessionStart) {
+		return;
+	}
+
+	int64_t now = k_uptime_get();
+
+	// Reconnect latency: the part after encryption shrinks when a bonded client skips discovery
+	LOG_INF("First volume command %u ms after connect (security level %u)\n",
+		(uint32_t)(now - sessionStart), bt_conn_get_security(conn));
+	if (encryptedAt) {
+		LOG_INF("First volume command %u ms after encryption\n", (uint32_t)(now - encryptedAt));
+	}
+	sessionStart = 0;
+}
+
 void adv_start_handler(struct k_work *work)
 {
 	(void)(work);
@@ -78,6 +133,14 @@ void bt_ready(int err)
 
 	LOG_DBG("Bluetooth ready\n");
 
+	// Restore bonds and their CCC state before a bonded client can reconnect
+	if (IS_ENABLED(CONFIG_SETTINGS)) {
+		err = settings_load();
+		if (err) {
+			LOG_WRN("Failed to load settings (%d)\n", err);
+		}
+	}
+
 	k_work_init(&adv_start_work, adv_start_handler);
 	k_work_submit(&adv_start_work);
 }
@@ -85,6 +148,8 @@ void bt_ready(int err)
 uint8_t initBluetooth(void) {
 	int err;
 
+	vcsCommandCallbackSet(commandAccepted);
+
 	err = bt_enable(bt_ready);
 	if (err) {
 		LOG_ERR("bt_enable failed (%d)\n", err);
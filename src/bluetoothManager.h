@@ -15,6 +15,7 @@
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/bluetooth/hci.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
 #include "volumeControlService.h"
 
 /** @brief Full device name from configuration */
@@ -52,6 +53,27 @@ void connected(struct bt_conn *conn, uint8_t err);
  */
 void disconnected(struct bt_conn *conn, uint8_t reason);
 
+#if defined(CONFIG_BT_SMP)
+/**
+ * @brief Link security changed callback
+ * @details Once the link is encrypted the stack opens the EATT bearers
+ *          (CONFIG_BT_EATT_AUTO_CONNECT), letting reads, writes and
+ *          notifications proceed in parallel.
+ * @param conn Bluetooth connection handle
+ * @param level New security level
+ * @param err Security error (0 = success)
+ */
+void securityChanged(struct bt_conn *conn, bt_security_t level, enum bt_security_err err);
+#endif
+
+/**
+ * @brief Accepted Control Point write callback
+ * @details Logs the time from connection, and from link encryption, to the first
+ *          accepted volume command.
+ * @param conn Bluetooth connection handle
+ */
+void commandAccepted(struct bt_conn *conn);
+
 /**
  * @brief Work handler to restart advertising
  * @param work Work item that triggered this handler
@@ -60,6 +82,7 @@ void adv_start_handler(struct k_work *work);
 
 /**
  * @brief Bluetooth stack ready callback
+ * @details Loads persisted bonds and CCC state before advertising starts.
  * @param err Bluetooth initialization error code (0 = success)
  */
 void bt_ready(int err);
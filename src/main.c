@@ -35,7 +35,7 @@ uint8_t init() {
 	}
 
 	if (!initButton()) {
-		LOG_WRN("Info button initialization failed\n");
+		LOG_WRN("Button initialization failed\n");
 	}
 
 	// Initialize Bluetooth
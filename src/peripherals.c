@@ -3,10 +3,26 @@
 
 LOG_MODULE_REGISTER(peripherals, 4);
 
-struct gpio_dt_spec infoButton = GPIO_DT_SPEC_GET_OR(DT_ALIAS(sw0), gpios, {0});
+struct localButton localButtons[] = {
+	{ .spec = GPIO_DT_SPEC_GET_OR(DT_ALIAS(sw0), gpios, {0}), .action = LOCAL_ACTION_INFO },
+	{ .spec = GPIO_DT_SPEC_GET_OR(DT_ALIAS(sw1), gpios, {0}), .action = LOCAL_ACTION_VOLUME_DOWN },
+	{ .spec = GPIO_DT_SPEC_GET_OR(DT_ALIAS(sw2), gpios, {0}), .action = LOCAL_ACTION_VOLUME_UP },
+	{ .spec = GPIO_DT_SPEC_GET_OR(DT_ALIAS(sw3), gpios, {0}), .action = LOCAL_ACTION_MUTE_TOGGLE },
+};
 struct gpio_dt_spec statusLed = GPIO_DT_SPEC_GET(DT_ALIAS(led1), gpios);
 struct k_work_delayable statusLedWork;
-struct gpio_callback buttonCb;
+
+/** @brief Number of button ISR invocations */
+static atomic_t isrCount;
+
+/** @brief Longest observed button ISR execution time in cycles */
+static atomic_t isrMaxCycles;
+
+/** @brief Uptime (ms) of the last accepted local volume change, for rate limiting */
+static int64_t lastLocalVolumeChange;
+
+/** @brief Local volume steps dropped by the rate limiter */
+static uint32_t rateLimitedCount;
 
 void statusLedHandler(struct k_work *work)
 {
@@ -18,43 +34,171 @@ void statusLedHandler(struct k_work *work)
 
 void buttonPressed(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
 {
+	uint32_t start = k_cycle_get_32();
+	struct localButton *button = CONTAINER_OF(cb, struct localButton, cb);
+
+	(void)(dev);
+	(void)(pins);
+
+	// Every bounce restarts the debounce window; the work item decides what the edge meant.
+	// A new edge is a new press, so a quick re-press waits out the full repeat delay again.
+	button->edgeCycles = start;
+	button->held = false;
+	k_work_reschedule(&button->work, K_MSEC(BUTTON_DEBOUNCE_MS));
+
+	uint32_t elapsed = k_cycle_get_32() - start;
+	atomic_val_t max = atomic_get(&isrMaxCycles);
+	while ((uint32_t)max < elapsed && !atomic_cas(&isrMaxCycles, max, elapsed)) {
+		max = atomic_get(&isrMaxCycles);
+	}
+	atomic_inc(&isrCount);
+}
+
+void buttonIsrStats(uint32_t *count, uint32_t *maxNs)
+{
+	*count = (uint32_t)atomic_get(&isrCount);
+	*maxNs = k_cyc_to_ns_floor32((uint32_t)atomic_get(&isrMaxCycles));
+}
+
+/* Logs the volume state and input statistics (info button) */
+static void logInfo(void)
+{
+	struct volumeState state;
+	uint8_t flags;
+	uint32_t count, maxNs;
+
+	k_mutex_lock(&vcsLock, K_FOREVER);
+	state = vcsState;
+	flags = volumeFlags;
+	k_mutex_unlock(&vcsLock);
+
 	LOG_INF("\nVolume State:\n");
-	LOG_INF("  Volume Setting: %d\n", vcsState.volumeSetting);
-	LOG_INF("  Mute: %d\n", vcsState.mute);
-	LOG_INF("  Change Counter: %d\n", vcsState.changeCounter);
+	LOG_INF("  Volume Setting: %d\n", state.volumeSetting);
+	LOG_INF("  Mute: %d\n", state.mute);
+	LOG_INF("  Change Counter: %d\n", state.changeCounter);
 
 	LOG_INF("Volume Flags:\n");
-	LOG_INF("  Volume_Setting_Persisted: %d\n", (volumeFlags & 0x01)); // Get's the first bit (not really needed since it's the only one defined anyway)
+	LOG_INF("  Volume_Setting_Persisted: %d\n", (flags & VOLUME_FLAG_SETTING_PERSISTED)); // Get's the first bit (not really needed since it's the only one defined anyway)
+
+	buttonIsrStats(&count, &maxNs);
+	LOG_INF("Button ISR: %u calls, max %u ns\n", count, maxNs);
+	LOG_INF("Rate limited volume steps: %u\n", rateLimitedCount);
 }
 
-uint8_t initButton(void) {
+/* Passes a local operation to the VCS state engine */
+static void localOperation(uint8_t opcode)
+{
+	if (volumeLocalOperation(opcode)) {
+		LOG_ERR("Local operation %d rejected\n", opcode);
+	}
+}
+
+/* Applies a relative volume change unless local changes are arriving faster than the rate limit */
+static void localVolumeStep(uint8_t opcode)
+{
+	int64_t now = k_uptime_get();
+
+	if (now - lastLocalVolumeChange < LOCAL_VOLUME_MIN_INTERVAL_MS) {
+		rateLimitedCount++;
+		LOG_DBG("Local volume change rate limited (%u dropped)\n", rateLimitedCount);
+		return;
+	}
+
+	lastLocalVolumeChange = now;
+	localOperation(opcode);
+}
+
+void buttonWorkHandler(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct localButton *button = CONTAINER_OF(dwork, struct localButton, work);
+	bool repeat = button->action == LOCAL_ACTION_VOLUME_DOWN || button->action == LOCAL_ACTION_VOLUME_UP;
+
+	if (gpio_pin_get_dt(&button->spec) <= 0) {
+		button->held = false; // Released, or the edge was only a bounce
+		return;
+	}
+
+	if (!button->held) {
+		LOG_DBG("Button %d pressed, %u us after edge\n", button->action,
+			k_cyc_to_us_floor32(k_cycle_get_32() - button->edgeCycles));
+	}
+
+	switch (button->action) {
+		case LOCAL_ACTION_INFO:
+			logInfo();
+			break;
+		case LOCAL_ACTION_VOLUME_DOWN:
+			localVolumeStep(VOLUME_DOWN);
+			break;
+		case LOCAL_ACTION_VOLUME_UP:
+			localVolumeStep(VOLUME_UP);
+			break;
+		case LOCAL_ACTION_MUTE_TOGGLE:
+			localOperation(VOLUME_MUTE_TOGGLE);
+			break;
+	}
+
+	if (repeat) {
+		k_timeout_t delay = K_MSEC(button->held ? BUTTON_REPEAT_INTERVAL_MS : BUTTON_REPEAT_DELAY_MS);
+
+		// Mark held before scheduling; an edge in between clears it and keeps its debounce timeout
+		button->held = true;
+		k_work_schedule(&button->work, delay);
+	}
+}
+
+/* Configures one button GPIO, its interrupt and its debounce work item */
+static uint8_t initLocalButton(struct localButton *button) {
   int ret;
 
-  if (!gpio_is_ready_dt(&infoButton)) {
-		LOG_ERR("Error: info button device %s is not ready\n", infoButton.port->name);
+  if (!gpio_is_ready_dt(&button->spec)) {
+		LOG_ERR("Error: button device %s is not ready\n", button->spec.port->name);
 		return 0;
 	}
 
-	ret = gpio_pin_configure_dt(&infoButton, GPIO_INPUT);
+	ret = gpio_pin_configure_dt(&button->spec, GPIO_INPUT);
 	if (ret != 0) {
-		LOG_ERR("Error %d: failed to configure %s pin %d\n", ret, infoButton.port->name, infoButton.pin);
+		LOG_ERR("Error %d: failed to configure %s pin %d\n", ret, button->spec.port->name, button->spec.pin);
 		return 0;
 	}
 
-	ret = gpio_pin_interrupt_configure_dt(&infoButton, GPIO_INT_EDGE_TO_ACTIVE);
+	k_work_init_delayable(&button->work, buttonWorkHandler);
+
+	ret = gpio_pin_interrupt_configure_dt(&button->spec, GPIO_INT_EDGE_TO_ACTIVE);
 	if (ret != 0) {
-		LOG_ERR("Error %d: failed to configure interrupt on %s pin %d\n", ret, infoButton.port->name, infoButton.pin);
+		LOG_ERR("Error %d: failed to configure interrupt on %s pin %d\n", ret, button->spec.port->name, button->spec.pin);
 		return 0;
 	}
 
-	gpio_init_callback(&buttonCb, buttonPressed, BIT(infoButton.pin));
-	gpio_add_callback(infoButton.port, &buttonCb);
+	gpio_init_callback(&button->cb, buttonPressed, BIT(button->spec.pin));
+	ret = gpio_add_callback(button->spec.port, &button->cb);
 
 	if (ret != 0) {
-		LOG_ERR("Failed to initialize info button: %d\n", ret);
+		LOG_ERR("Failed to initialize button: %d\n", ret);
+		return 0;
+	}
+
+	return 1;
+}
+
+uint8_t initButton(void) {
+	// The info button is mandatory, the volume buttons are optional extras
+	if (localButtons[0].spec.port == NULL || !initLocalButton(&localButtons[0])) {
 		return 0;
 	}
 
+	for (size_t i = 1; i < ARRAY_SIZE(localButtons); i++) {
+		if (localButtons[i].spec.port == NULL) {
+			LOG_WRN("Button for action %d not present on this board\n", localButtons[i].action);
+			continue;
+		}
+
+		if (!initLocalButton(&localButtons[i])) {
+			LOG_WRN("Button for action %d unavailable\n", localButtons[i].action);
+		}
+	}
+
 	return 1;
 }
 
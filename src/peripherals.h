@@ -14,8 +14,45 @@
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/logging/log.h>
 
-/** @brief GPIO specification for info button (typically button 1 on nRF52DK) */
-extern struct gpio_dt_spec infoButton;
+/** @brief Time (ms) a button must stay active after an edge before it counts as pressed */
+#define BUTTON_DEBOUNCE_MS 20
+
+/** @brief Time (ms) a volume button must be held before auto-repeat starts */
+#define BUTTON_REPEAT_DELAY_MS 500
+
+/** @brief Auto-repeat period (ms) while a volume button is held */
+#define BUTTON_REPEAT_INTERVAL_MS 150
+
+/** @brief Minimum spacing (ms) between local volume changes, across all buttons */
+#define LOCAL_VOLUME_MIN_INTERVAL_MS 100
+
+/**
+ * @brief Actions that can be bound to a local button
+ */
+enum LOCAL_ACTIONS {
+  LOCAL_ACTION_INFO,         /**< Log volume state and input statistics */
+  LOCAL_ACTION_VOLUME_DOWN,  /**< Relative volume down, auto-repeats while held */
+  LOCAL_ACTION_VOLUME_UP,    /**< Relative volume up, auto-repeats while held */
+  LOCAL_ACTION_MUTE_TOGGLE,  /**< Toggle mute */
+};
+
+/**
+ * @brief Local input button bound to an action
+ *
+ * The ISR only timestamps the edge and (re)schedules @ref work; debounce,
+ * hold detection and auto-repeat all run from the system work queue.
+ */
+struct localButton {
+	struct gpio_dt_spec spec;      /**< Button GPIO */
+	enum LOCAL_ACTIONS action;     /**< Action performed on press */
+	struct gpio_callback cb;       /**< GPIO interrupt callback */
+	struct k_work_delayable work;  /**< Debounce/auto-repeat work item */
+	uint32_t edgeCycles;           /**< Cycle count of the last active edge */
+	bool held;                     /**< Press accepted and auto-repeat armed; cleared by every new edge */
+};
+
+/** @brief Local input buttons (info, volume down, volume up, mute on nRF52DK buttons 1-4) */
+extern struct localButton localButtons[];
 
 /** @brief GPIO specification for status LED (typically LED 1 on nRF52DK) */
 extern struct gpio_dt_spec statusLed;
@@ -23,9 +60,6 @@ extern struct gpio_dt_spec statusLed;
 /** @brief Delayable work item for LED blinking during advertising */
 extern struct k_work_delayable statusLedWork;
 
-/** @brief GPIO callback structure for button press handling */
-extern struct gpio_callback buttonCb;
-
 /**
  * @brief Work handler for status LED blinking
  * @param work Work item that triggered this handler
@@ -34,6 +68,8 @@ void statusLedHandler(struct k_work *work);
 
 /**
  * @brief GPIO interrupt callback for button presses
+ * @details Runs in ISR context: only records the edge time and schedules the
+ *          button's debounce work. Its own execution time is tracked for buttonIsrStats().
  * @param dev GPIO device that triggered the interrupt
  * @param cb GPIO callback structure
  * @param pins Bitmask of pins that triggered the interrupt
@@ -41,7 +77,22 @@ void statusLedHandler(struct k_work *work);
 void buttonPressed(const struct device *dev, struct gpio_callback *cb, uint32_t pins);
 
 /**
- * @brief Initialize info button GPIO and interrupt
+ * @brief Work handler for button debounce and auto-repeat
+ * @param work Work item that triggered this handler
+ */
+void buttonWorkHandler(struct k_work *work);
+
+/**
+ * @brief Read button ISR execution statistics
+ * @param count Output for number of ISR invocations
+ * @param maxNs Output for longest observed ISR execution time in nanoseconds
+ */
+void buttonIsrStats(uint32_t *count, uint32_t *maxNs);
+
+/**
+ * @brief Initialize button GPIOs and interrupts
+ * @details The info button is required; the volume and mute buttons are
+ *          skipped if the board does not provide them.
  * @return 1 on success, 0 on failure
  */
 uint8_t initButton(void);